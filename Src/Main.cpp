@@ -27,6 +27,8 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <intrin.h>
+#include <emmintrin.h>
 
 #include <cinttypes>
 #include <string>
@@ -105,13 +107,13 @@ uint64_t ReadNumber(std::wstring wstrBanner){
 /// \brief Read the file size.
 ///
 /// Prompt the user for a file size, repeating the request as necessary until
-/// a non-zero number is read.
-/// \return A non-zero file size.
+/// a non-zero number is read or the input ends.
+/// \return A non-zero file size, or zero if the input ended.
 
 uint64_t ReadFileSize(){
   uint64_t n = 0; //file size in GB
 
-  while(n == 0) //get nonzero n from user
+  while(n == 0 && std::wcin) //get nonzero n from user
     n = ReadNumber(L"Enter file size in GB: ");
   return n;
 } //ReadFileSize
@@ -147,17 +149,151 @@ prng_state GenerateShiShuaState(){
   return s;
 } //InitializeShiShuaState
 
+/// \brief Noise source.
+///
+/// Either generate every byte with `shishua`, or mix a pre-generated pool
+/// with a short freshly generated stride to save CPU cycles on weak hosts.
+
+enum class eNoise{
+  Full, ///< Generate every byte with `shishua`.
+  LowCPU ///< Mix a pre-generated pool with a fresh `shishua` stride.
+}; //eNoise
+
+const uint64_t nGB = 1073741824; ///< Bytes per GB.
+const size_t nChunkSize = 262144; ///< Output chunk and pool size, 256KB.
+const size_t nStrideSize = 4096; ///< Stride size for low-CPU mode, 4KB.
+
+/// \brief Read the noise source.
+///
+/// Prompt the user for the noise source, repeating the request as necessary
+/// until `0`, `1`, `2`, or an empty line is read. An empty line or the end
+/// of input defaults to full generation.
+/// \param bBenchmark [out] true if the user asked for a benchmark instead.
+/// \return The noise source.
+
+eNoise ReadNoiseSource(bool& bBenchmark){
+  std::wstring wstr; //for the input line
+
+  do{
+    std::wcout << L"Enter noise source (0 = full, 1 = low-CPU, " <<
+      L"2 = benchmark both), default 0: " << std::endl << "> ";
+    wstr.clear();
+    std::getline(std::wcin, wstr); //input a line
+  }while(std::wcin && !wstr.empty() && wstr != L"0" && wstr != L"1" &&
+    wstr != L"2");
+
+  bBenchmark = wstr == L"2";
+  return wstr == L"1"? eNoise::LowCPU: eNoise::Full;
+} //ReadNoiseSource
+
+/// \brief Mix the noise pool into a chunk.
+///
+/// Fill a chunk by XORing the noise pool with a 4KB stride freshly generated
+/// by `shishua` and repeated across the chunk, that is, the chunk is the pool
+/// XOR a keystream with period 4KB. This costs `shishua` 4KB per chunk plus
+/// a cache-resident SSE2 XOR instead of generating every byte.
+/// \param pool Noise pool of size `nChunkSize`.
+/// \param chunk [out] Output chunk of size `nChunkSize`.
+/// \param pState Pointer to `shishua` state.
+
+void MixPool(const uint8_t* pool, uint8_t* chunk, prng_state* pState){
+  alignas(16) uint8_t stride[nStrideSize]; //stride for this chunk
+  prng_gen(pState, stride, nStrideSize); //fresh stride
+
+  for(size_t i=0; i<nChunkSize; i+=nStrideSize) //once for each stride
+    for(size_t j=0; j<nStrideSize; j+=16){ //once for each 16 bytes
+      const __m128i a = _mm_loadu_si128((const __m128i*)(pool + i + j));
+      const __m128i b = _mm_load_si128((const __m128i*)(stride + j));
+      _mm_storeu_si128((__m128i*)(chunk + i + j), _mm_xor_si128(a, b));
+    } //for
+} //MixPool
+
+/// \brief Generate noise.
+///
+/// Fill a chunk with noise from the given source.
+/// \param t Noise source.
+/// \param pool Noise pool for low-CPU mode, may be `nullptr` otherwise.
+/// \param chunk [out] Output chunk of size `nChunkSize`.
+/// \param pState Pointer to `shishua` state.
+
+void GenerateNoise(eNoise t, const uint8_t* pool, uint8_t* chunk,
+  prng_state* pState)
+{
+  if(t == eNoise::LowCPU)
+    MixPool(pool, chunk, pState); //cheap mixing
+  else prng_gen(pState, chunk, nChunkSize); //full generation
+} //GenerateNoise
+
+/// \brief Create a noise pool.
+///
+/// Create and fill the noise pool if it is needed by the noise source.
+/// \param t Noise source.
+/// \param pState Pointer to `shishua` state.
+/// \return Pointer to the noise pool, `nullptr` if not needed.
+
+uint8_t* CreatePool(eNoise t, prng_state* pState){
+  if(t != eNoise::LowCPU)return nullptr;
+
+  uint8_t* pool = new uint8_t[nChunkSize]; //noise pool
+  prng_gen(pState, pool, nChunkSize); //generate pool once using shishua
+  return pool;
+} //CreatePool
+
+/// \brief Print cycles per byte.
+///
+/// Print the number of CPU cycles per byte of noise to `std::cout`.
+/// \param t Noise source.
+/// \param nCycles Number of CPU cycles.
+/// \param nBytes Number of bytes.
+
+void PrintCyclesPerByte(eNoise t, uint64_t nCycles, uint64_t nBytes){
+  std::cout << (t == eNoise::LowCPU? "Low-CPU": "Full") << " noise: " <<
+    double(nCycles)/double(nBytes) << " cycles/byte" << std::endl;
+} //PrintCyclesPerByte
+
+/// \brief Benchmark the noise sources.
+///
+/// Time full and low-CPU noise generation of 1GB, one chunk at a time as in
+/// `GenerateFile()`, and report the cost of each in CPU cycles per byte.
+/// Nothing is written to disk.
+/// \param pState Pointer to `shishua` state.
+
+void Benchmark(prng_state* pState){
+  uint8_t* chunk = new uint8_t[nChunkSize]; //output chunk
+
+  for(eNoise t: {eNoise::Full, eNoise::LowCPU}){ //for each noise source
+    uint8_t* pool = CreatePool(t, pState); //noise pool, if needed
+    GenerateNoise(t, pool, chunk, pState); //warm up
+
+    const uint64_t nStart = __rdtsc(); //start time
+
+    for(uint64_t i=0; i<nGB; i+=nChunkSize) //once for each chunk
+      GenerateNoise(t, pool, chunk, pState);
+
+    PrintCyclesPerByte(t, __rdtsc() - nStart, nGB);
+    delete [] pool;
+  } //for
+
+  delete [] chunk;
+} //Benchmark
+
 /// \brief Generate a file of pseudo-random bytes.
 ///
 /// Generate a file of pseudo-random bytes using `shishua`. Assumes that `shishua`
-/// has been initialized and seeded.
+/// has been initialized and seeded. The output is generated and written one
+/// cache-sized chunk at a time. The cost of noise generation, excluding disk
+/// writes, is reported in CPU cycles per byte.
 /// \param wstrFile Output file name.
 /// \param n Number of GB of output.
 /// \param pState Pointer to `shishua` state.
+/// \param t Noise source.
 
-void GenerateFile(const std::wstring& wstrFile, size_t n, prng_state* pState){
-  const size_t nBufSize = 1073741824; //1GB buffer
-  uint8_t* buffer = new uint8_t[nBufSize]; //output buffer
+void GenerateFile(const std::wstring& wstrFile, size_t n, prng_state* pState,
+  eNoise t)
+{
+  uint8_t* chunk = new uint8_t[nChunkSize]; //output chunk
+  uint8_t* pool = CreatePool(t, pState); //noise pool, if needed
+  uint64_t nCycles = 0; //CPU cycles spent generating noise
 
   FILE* output = nullptr; //output file pointer
   _wfopen_s(&output, wstrFile.c_str(), L"wb"); 
@@ -167,33 +303,52 @@ void GenerateFile(const std::wstring& wstrFile, size_t n, prng_state* pState){
   
   else{ //output file opened successfully
     for(uint64_t i=0; i<n; i++){ //once for each GB of output
-      prng_gen(pState, buffer, nBufSize); //generate 1GB using shishua
-      fwrite(buffer, nBufSize, 1, output); //write to disk
+      for(uint64_t j=0; j<nGB; j+=nChunkSize){ //once for each chunk
+        const uint64_t nStart = __rdtsc(); //start time
+        GenerateNoise(t, pool, chunk, pState); //generate a chunk
+        nCycles += __rdtsc() - nStart; //time spent generating
+        fwrite(chunk, nChunkSize, 1, output); //write to disk
+      } //for
+
       fflush(output); //flush
       std::cout << "."; //to show user progress
     } //for
     
     std::cout << std::endl;
     fclose(output);
+    PrintCyclesPerByte(t, nCycles, uint64_t(n)*nGB);
   } //if
 
-  delete [] buffer;
+  delete [] pool;
+  delete [] chunk;
 } //GenerateFile
 
 /// \brief Main.
 ///
-/// Prompt the user for a file size and create a file of that many GB of
-/// pseudo-random noise.
+/// Prompt the user for a noise source and a file size, and create a file of
+/// that many GB of pseudo-random noise. Alternatively, benchmark the noise
+/// sources without writing to disk.
 /// \return 0 (What could possibly go wrong?)
 
 int main(){
   std::cout << "Create a large file of pseudo-random bytes." << std::endl;
 
   prng_state s = GenerateShiShuaState(); //shishua state
-  uint64_t n = ReadFileSize(); //file size in GB
-  std::wstring wstrFileName = GetNextFileName(); //output file name
+  bool bBenchmark = false; //true to benchmark instead of creating a file
+  const eNoise t = ReadNoiseSource(bBenchmark); //noise source
+
+  if(bBenchmark)
+    Benchmark(&s); //benchmark noise sources
+
+  else{ //create a file
+    uint64_t n = ReadFileSize(); //file size in GB
+
+    if(n > 0){ //input did not end before a file size was read
+      std::wstring wstrFileName = GetNextFileName(); //output file name
+      GenerateFile(wstrFileName, n, &s, t); //generate and save the file
+    } //if
+  } //else
 
-  GenerateFile(wstrFileName, n, &s); //generate and save the file
   system("pause"); //wait for user response
 
   return 0; //what could possibly go wrong?